@@ -0,0 +1,857 @@
+/**
+ * This program stores a set of text files in one compressed archive.
+ * Each file is split into content-defined chunks, and each distinct
+ * chunk is compressed and stored only once, so files that share a lot
+ * of text take little more room than one copy.  A single member can be
+ * extracted by decoding just its own chunks.
+ *
+ * @file archive.c
+ * @author Louis Warner
+*/
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "wordlist.h"
+#include "bits.h"
+#include "trace.h"
+
+/** Magic number at the start of every archive file.  The last character
+    is the format version. */
+#define MAGIC "PKA2"
+
+/** Number of bytes in the magic number. */
+#define MAGIC_LEN 4
+
+/** Number of bytes in each count or id in the archive index. */
+#define INT_BYTES 4
+
+/** Number of bytes in each file offset in the archive header and index,
+    so an archive can grow past 4 GiB. */
+#define LONG_BYTES 8
+
+/** Number of bytes in the index entry for each stored chunk: its offset,
+    code count and length. */
+#define STORED_BYTES ( LONG_BYTES + 2 * INT_BYTES )
+
+/** Smallest chunk we'll cut, except at the end of a file. */
+#define MIN_CHUNK 256
+
+/** Largest chunk we'll cut.  A chunk is cut here even if the content
+    doesn't call for it. */
+#define MAX_CHUNK 4096
+
+/** A chunk ends where the high-order bits of the rolling hash picked
+    out by this mask are all zero, about once every 1024 characters. */
+#define CHUNK_MASK 0xFFC00000u
+
+/** Seed for the table of random values used by the rolling hash.  It's
+    fixed, so the same text is always cut into the same chunks. */
+#define GEAR_SEED 0x9E3779B9u
+
+/** Starting value for the 64-bit FNV-1a hash. */
+#define FNV_OFFSET 0xCBF29CE484222325ull
+
+/** Multiplier for the 64-bit FNV-1a hash. */
+#define FNV_PRIME 0x100000001B3ull
+
+/** Fewest chunks worth handing to a thread of their own. */
+#define CHUNKS_PER_THREAD 64
+
+/** Most threads we'll use for hashing. */
+#define MAX_THREADS 64
+
+/** Members are read ahead until they have at least this many chunks
+    between them, so their chunks can be hashed in one parallel pass,
+    even when each member is too small to be worth splitting up. */
+#define BATCH_CHUNKS ( MAX_THREADS * CHUNKS_PER_THREAD )
+
+/** Usage message, printed for bad command-line arguments. */
+#define USAGE "usage: archive [-j threads] -c <archive.pka> <file.txt>...\n" \
+              "       archive -x <archive.pka> <member> <output.txt>\n" \
+              "       archive -t <archive.pka>\n"
+
+/** A piece of a member in the batch being added. */
+typedef struct {
+  /** Start of the chunk, inside its member's text. */
+  char const *text;
+
+  /** Number of characters in the chunk. */
+  int len;
+
+  /** Hash of the chunk's contents. */
+  uint64_t hash;
+} Chunk;
+
+/** A chunk stored in the archive.  Only this much is kept for each one
+    while the archive is built, not its text. */
+typedef struct {
+  /** Hash of the chunk's contents. */
+  uint64_t hash;
+
+  /** Number of characters in the chunk. */
+  int len;
+
+  /** Number of codes in the chunk's code stream. */
+  int codeCount;
+
+  /** Position of the chunk's code stream in the archive. */
+  off_t offset;
+} Stored;
+
+/** A file added to the archive. */
+typedef struct {
+  /** Name the member is stored under. */
+  char const *name;
+
+  /** Contents of the file, while it's in the batch being added. */
+  char *text;
+
+  /** Index of the member's first chunk in the batch. */
+  int first;
+
+  /** Ids of the stored chunks making up the member, in order. */
+  int *ids;
+
+  /** Number of chunks in the member. */
+  int chunkCount;
+} Member;
+
+/** Range of chunks for one hashing thread. */
+typedef struct {
+  /** Chunks to hash. */
+  Chunk *chunks;
+
+  /** Number of chunks to hash. */
+  int count;
+} HashJob;
+
+/** Random values for the rolling hash, one for each byte value. */
+static uint32_t gear[ 256 ];
+
+/** Number of hashing threads given with -j, or zero for one per core. */
+static int threadLimit = 0;
+
+
+/**
+ * Fills in the table of random values for the rolling hash, using a
+ * xorshift generator with a fixed seed.
+ */
+static void initGear( void )
+{
+  uint32_t x = GEAR_SEED;
+  for ( int i = 0; i < 256; i++ ) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gear[ i ] = x;
+  }
+}
+
+
+/**
+ * Writes an unsigned value to the archive, low-order byte first.
+ *
+ * @param unsigned long long value - value to write
+ * @param int bytes - number of bytes to write it in
+ * @param FILE *fp - archive file, opened for writing
+ */
+static void writeBytes( unsigned long long value, int bytes, FILE *fp )
+{
+  for ( int i = 0; i < bytes; i++ ) {
+    fputc( ( value >> ( i * BITS_PER_BYTE ) ) & 0xFF, fp );
+  }
+}
+
+
+/**
+ * Reads an unsigned value from the archive, written by writeBytes().
+ * Exits with an error if the archive ends first.
+ *
+ * @param int bytes - number of bytes the value was written in
+ * @param FILE *fp - archive file, opened for reading
+ * @return unsigned long long value - value read in
+ */
+static unsigned long long readBytes( int bytes, FILE *fp )
+{
+  unsigned long long value = 0;
+  for ( int i = 0; i < bytes; i++ ) {
+    int ch = fgetc( fp );
+    if ( ch == EOF ) {
+      fprintf(stderr, "Invalid archive file\n");
+      exit( EXIT_FAILURE );
+    }
+    value |= (unsigned long long)ch << ( i * BITS_PER_BYTE );
+  }
+  return value;
+}
+
+
+/**
+ * Writes a count or id to the archive.
+ *
+ * @param unsigned int value - value to write
+ * @param FILE *fp - archive file, opened for writing
+ */
+static void writeInt( unsigned int value, FILE *fp )
+{
+  writeBytes( value, INT_BYTES, fp );
+}
+
+
+/**
+ * Reads a count or id from the archive, written by writeInt().
+ *
+ * @param FILE *fp - archive file, opened for reading
+ * @return unsigned int value - value read in
+ */
+static unsigned int readInt( FILE *fp )
+{
+  return readBytes( INT_BYTES, fp );
+}
+
+
+/**
+ * Writes a file offset to the archive.
+ *
+ * @param off_t value - offset to write
+ * @param FILE *fp - archive file, opened for writing
+ */
+static void writeLong( off_t value, FILE *fp )
+{
+  writeBytes( value, LONG_BYTES, fp );
+}
+
+
+/**
+ * Reads a file offset from the archive, written by writeLong().
+ *
+ * @param FILE *fp - archive file, opened for reading
+ * @return off_t value - offset read in
+ */
+static off_t readLong( FILE *fp )
+{
+  return readBytes( LONG_BYTES, fp );
+}
+
+
+/**
+ * Reads the entire contents of the given file into a dynamically allocated,
+ * null terminated string, checking that every character is valid.
+ *
+ * @param char const *fname - name of the file to read
+ * @param int *len - set to the number of characters in the file
+ * @return char* buffer - string containing the entire contents of the file
+ */
+static char *readMember( char const *fname, int *len )
+{
+  FILE *fp;
+  if (( fp = fopen( fname, "r" )) == NULL ) {
+    fprintf(stderr, "Can't open file: %s\n", fname);
+    exit( EXIT_FAILURE );
+  }
+
+  int capacity = 5;
+  char *buffer = (char *)malloc( (capacity + 1) * sizeof(char) );
+  int ch;
+  *len = 0;
+  while ( ( ch = fgetc( fp ) ) != EOF ) {
+    if ( *len >= capacity ) {
+      capacity *= 2;
+      buffer = (char *)realloc( buffer, (capacity + 1) * sizeof(char) );
+    }
+    if ( !validChar( ch ) ) {
+      fprintf(stderr, "Invalid character code: %X\n", ch);
+      exit( EXIT_FAILURE );
+    }
+    buffer[ (*len)++ ] = ch;
+  }
+  buffer[ *len ] = '\0';
+
+  fclose( fp );
+  return buffer;
+}
+
+
+/**
+ * Cuts the given text into content-defined chunks, adding them to the end
+ * of the chunk list.  A chunk ends where a rolling hash of the last few
+ * characters hits a particular pattern, so an edit in one place only
+ * changes the chunks around it.
+ *
+ * @param char const *text - text to cut up
+ * @param int len - number of characters in the text
+ * @param Chunk **chunks - resizable list of chunks
+ * @param int *count - number of chunks in the list
+ * @param int *capacity - capacity of the list
+ */
+static void cutChunks( char const *text, int len, Chunk **chunks, int *count, int *capacity )
+{
+  int start = 0;
+  while ( start < len ) {
+    uint32_t hash = 0;
+    int end = start;
+    while ( end < len ) {
+      hash = ( hash << 1 ) + gear[ (unsigned char) text[ end ] ];
+      end++;
+      int size = end - start;
+      if ( size >= MAX_CHUNK || ( size >= MIN_CHUNK && ( hash & CHUNK_MASK ) == 0 ) ) {
+        break;
+      }
+    }
+
+    if ( *count >= *capacity ) {
+      *capacity *= 2;
+      *chunks = (Chunk *)realloc( *chunks, *capacity * sizeof( Chunk ) );
+    }
+    Chunk *chunk = *chunks + (*count)++;
+    chunk->text = text + start;
+    chunk->len = end - start;
+    start = end;
+  }
+}
+
+
+/**
+ * Thread start routine that computes the FNV-1a hash for a range of chunks.
+ *
+ * @param void *arg - the HashJob for this thread
+ * @return NULL
+ */
+static void *hashChunks( void *arg )
+{
+  HashJob *job = (HashJob *) arg;
+  long long start = traceClock();
+
+  for ( int i = 0; i < job->count; i++ ) {
+    Chunk *chunk = job->chunks + i;
+    uint64_t hash = FNV_OFFSET;
+    for ( int j = 0; j < chunk->len; j++ ) {
+      hash ^= (unsigned char) chunk->text[ j ];
+      hash *= FNV_PRIME;
+    }
+    chunk->hash = hash;
+  }
+
+  traceSpan( "hash", start );
+  return NULL;
+}
+
+
+/**
+ * Hashes all the chunks, splitting the work across the number of threads
+ * given with -j, or one thread per core.
+ *
+ * @param Chunk *chunks - list of chunks
+ * @param int count - number of chunks in the list
+ */
+static void hashAll( Chunk *chunks, int count )
+{
+  // Don't bother with threads for just a few chunks.
+  int threads = threadLimit > 0 ? threadLimit : sysconf( _SC_NPROCESSORS_ONLN );
+  if ( threads > count / CHUNKS_PER_THREAD ) {
+    threads = count / CHUNKS_PER_THREAD;
+  }
+  if ( threads > MAX_THREADS ) {
+    threads = MAX_THREADS;
+  }
+  if ( threads < 1 ) {
+    threads = 1;
+  }
+
+  pthread_t ids[ MAX_THREADS ];
+  HashJob jobs[ MAX_THREADS ];
+  int first = 0;
+  for ( int t = 0; t < threads; t++ ) {
+    int last = (long long) count * ( t + 1 ) / threads;
+    jobs[ t ].chunks = chunks + first;
+    jobs[ t ].count = last - first;
+    first = last;
+  }
+
+  // With just one job, it's simpler to do it here.
+  if ( threads == 1 ) {
+    hashChunks( jobs );
+    return;
+  }
+
+  for ( int t = 0; t < threads; t++ ) {
+    if ( pthread_create( ids + t, NULL, hashChunks, jobs + t ) != 0 ) {
+      fprintf(stderr, "Can't create thread\n");
+      exit( EXIT_FAILURE );
+    }
+  }
+  for ( int t = 0; t < threads; t++ ) {
+    pthread_join( ids[ t ], NULL );
+  }
+}
+
+
+/**
+ * Compresses one chunk and writes it to the end of the archive as a
+ * self-contained code stream, ending with a flushed partial byte.
+ *
+ * @param WordList *wordList - word list to compress with
+ * @param Chunk *chunk - chunk to compress
+ * @param Stored *stored - filled in with where and how the chunk was stored
+ * @param FILE *fp - archive file, opened for update
+ */
+static void writeChunk( WordList *wordList, Chunk *chunk, Stored *stored, FILE *fp )
+{
+  // Copy the chunk, so bestCode() can't match past the end of it.
+  char text[ MAX_CHUNK + 1 ];
+  memcpy( text, chunk->text, chunk->len );
+  text[ chunk->len ] = '\0';
+
+  fseeko( fp, 0, SEEK_END );
+  stored->hash = chunk->hash;
+  stored->len = chunk->len;
+  stored->offset = ftello( fp );
+
+  PendingBits pending = { 0, 0 };
+  int codes[ CODES_PER_BLOCK ];
+  int count = 0;
+  int total = 0;
+  int pos = 0;
+  while ( text[ pos ] ) {
+    int code = bestCode( wordList, text + pos );
+    codes[ count++ ] = code;
+    pos += strlen( wordList->words[ code ] );
+
+    if ( count == CODES_PER_BLOCK ) {
+      writeCodes( codes, count, &pending, fp );
+      total += count;
+      count = 0;
+    }
+  }
+  writeCodes( codes, count, &pending, fp );
+  total += count;
+  flushBits( &pending, fp );
+
+  stored->codeCount = total;
+}
+
+
+/**
+ * Decodes a stored chunk back into text.
+ *
+ * @param WordList *wordList - word list the archive was compressed with
+ * @param Stored *stored - chunk to decode
+ * @param char *text - room for MAX_CHUNK characters of decoded text
+ * @param FILE *fp - archive file, opened for reading
+ * @return bool ok - false if the chunk has a bad code or the wrong length
+ */
+static bool readChunk( WordList *wordList, Stored *stored, char *text, FILE *fp )
+{
+  if ( stored->len > MAX_CHUNK ) {
+    return false;
+  }
+  fseeko( fp, stored->offset, SEEK_SET );
+
+  // Each chunk is its own code stream, so start with no pending bits.
+  PendingBits pending = { 0, 0 };
+  int codes[ CODES_PER_BLOCK ];
+  int remaining = stored->codeCount;
+  int len = 0;
+  while ( remaining > 0 ) {
+    int want = remaining < CODES_PER_BLOCK ? remaining : CODES_PER_BLOCK;
+    int got = readCodes( codes, want, &pending, fp );
+    if ( got < want ) {
+      return false;
+    }
+    for ( int i = 0; i < got; i++ ) {
+      if ( codes[ i ] >= wordList->len ) {
+        return false;
+      }
+      int n = strlen( wordList->words[ codes[ i ] ] );
+      if ( len + n > stored->len ) {
+        return false;
+      }
+      memcpy( text + len, wordList->words[ codes[ i ] ], n );
+      len += n;
+    }
+    remaining -= got;
+  }
+
+  return len == stored->len;
+}
+
+
+/**
+ * Creates an archive from the given files.  The archive starts with the
+ * magic number and the offset of the index, followed by each distinct
+ * chunk's code stream.  The index at the end lists the offset, code count
+ * and length for each stored chunk, then the name and chunk list for each
+ * member.
+ *
+ * Members are added a batch at a time.  Each batch is read ahead until it
+ * has BATCH_CHUNKS chunks, so they can all be hashed in one parallel pass,
+ * and each member's text is freed once its new chunks are written.  A chunk
+ * with the same hash and length as a stored one is only reused after
+ * decoding the stored one and comparing.
+ *
+ * @param char const *aname - name of the archive file to create
+ * @param int count - number of files to store
+ * @param char *fnames[] - names of the files to store
+ */
+static void createArchive( char const *aname, int count, char *fnames[] )
+{
+  WordList *wordList = defaultWordList();
+
+  FILE *fp;
+  if (( fp = fopen( aname, "w+" )) == NULL ) {
+    fprintf(stderr, "Can't open file: %s\n", aname);
+    exit( EXIT_FAILURE );
+  }
+
+  // Header, with room for the index offset.
+  fwrite( MAGIC, 1, MAGIC_LEN, fp );
+  writeLong( 0, fp );
+
+  // Stored chunks, with an open-addressing hash table of their ids, kept
+  // at a power of two at least twice the number of stored chunks.
+  int storedCap = 5;
+  int storedCount = 0;
+  Stored *stored = (Stored *)malloc( storedCap * sizeof( Stored ) );
+  int tableSize = 16;
+  int *table = (int *)malloc( tableSize * sizeof( int ) );
+  for ( int i = 0; i < tableSize; i++ ) {
+    table[ i ] = -1;
+  }
+
+  Member *members = (Member *)malloc( count * sizeof( Member ) );
+  int chunkCap = 5;
+  Chunk *chunks = (Chunk *)malloc( chunkCap * sizeof( Chunk ) );
+  char text[ MAX_CHUNK ];
+  initGear();
+
+  int m = 0;
+  while ( m < count ) {
+    // Read members and cut them into chunks, until there are enough chunks
+    // to give every thread a full share.
+    long long start = traceClock();
+    int end = m;
+    int chunkCount = 0;
+    while ( end < count && chunkCount < BATCH_CHUNKS ) {
+      int len;
+      members[ end ].name = fnames[ end ];
+      members[ end ].text = readMember( fnames[ end ], &len );
+      members[ end ].first = chunkCount;
+      cutChunks( members[ end ].text, len, &chunks, &chunkCount, &chunkCap );
+      members[ end ].chunkCount = chunkCount - members[ end ].first;
+      end++;
+    }
+    traceSpan( "block read", start );
+
+    hashAll( chunks, chunkCount );
+
+    // Give each chunk the id of a stored chunk with the same contents,
+    // compressing and storing it first if there isn't one.
+    start = traceClock();
+    for ( ; m < end; m++ ) {
+      members[ m ].ids = (int *)malloc( ( members[ m ].chunkCount + 1 ) * sizeof( int ) );
+      for ( int i = 0; i < members[ m ].chunkCount; i++ ) {
+        Chunk *chunk = chunks + members[ m ].first + i;
+        int slot = chunk->hash & ( tableSize - 1 );
+        int id = -1;
+        while ( table[ slot ] >= 0 ) {
+          Stored *other = stored + table[ slot ];
+          if ( other->hash == chunk->hash && other->len == chunk->len &&
+               readChunk( wordList, other, text, fp ) &&
+               memcmp( text, chunk->text, chunk->len ) == 0 ) {
+            id = table[ slot ];
+            break;
+          }
+          slot = ( slot + 1 ) & ( tableSize - 1 );
+        }
+
+        if ( id < 0 ) {
+          if ( storedCount >= storedCap ) {
+            storedCap *= 2;
+            stored = (Stored *)realloc( stored, storedCap * sizeof( Stored ) );
+          }
+          id = storedCount++;
+          long long matchStart = traceClock();
+          writeChunk( wordList, chunk, stored + id, fp );
+          traceSpan( "match", matchStart );
+          table[ slot ] = id;
+
+          // Double the table and put the ids back, if it's over half full.
+          if ( 2 * storedCount > tableSize ) {
+            tableSize *= 2;
+            table = (int *)realloc( table, tableSize * sizeof( int ) );
+            for ( int j = 0; j < tableSize; j++ ) {
+              table[ j ] = -1;
+            }
+            for ( int j = 0; j < storedCount; j++ ) {
+              int s = stored[ j ].hash & ( tableSize - 1 );
+              while ( table[ s ] >= 0 ) {
+                s = ( s + 1 ) & ( tableSize - 1 );
+              }
+              table[ s ] = j;
+            }
+          }
+        }
+        members[ m ].ids[ i ] = id;
+      }
+
+      free( members[ m ].text );
+      members[ m ].text = NULL;
+    }
+    traceSpan( "dedup", start );
+  }
+
+  // Index, then go back and fill in its offset.
+  fseeko( fp, 0, SEEK_END );
+  off_t indexOffset = ftello( fp );
+  writeInt( storedCount, fp );
+  for ( int i = 0; i < storedCount; i++ ) {
+    writeLong( stored[ i ].offset, fp );
+    writeInt( stored[ i ].codeCount, fp );
+    writeInt( stored[ i ].len, fp );
+  }
+  writeInt( count, fp );
+  for ( int m = 0; m < count; m++ ) {
+    int nameLen = strlen( members[ m ].name );
+    writeInt( nameLen, fp );
+    fwrite( members[ m ].name, 1, nameLen, fp );
+    writeInt( members[ m ].chunkCount, fp );
+    for ( int i = 0; i < members[ m ].chunkCount; i++ ) {
+      writeInt( members[ m ].ids[ i ], fp );
+    }
+  }
+  fseeko( fp, MAGIC_LEN, SEEK_SET );
+  writeLong( indexOffset, fp );
+  fclose( fp );
+
+  // Free remaining allocated memory.
+  for ( int m = 0; m < count; m++ ) {
+    free( members[ m ].ids );
+  }
+  free( members );
+  free( chunks );
+  free( stored );
+  free( table );
+}
+
+
+/**
+ * Opens an archive, checks its magic number and moves to the start of its index.
+ *
+ * @param char const *aname - name of the archive file
+ * @return FILE *fp - the archive, positioned at the index
+ */
+static FILE *openArchive( char const *aname )
+{
+  FILE *fp;
+  if (( fp = fopen( aname, "r" )) == NULL ) {
+    fprintf(stderr, "Can't open file: %s\n", aname);
+    exit( EXIT_FAILURE );
+  }
+
+  char magic[ MAGIC_LEN ];
+  if ( fread( magic, 1, MAGIC_LEN, fp ) != MAGIC_LEN || memcmp( magic, MAGIC, MAGIC_LEN ) != 0 ) {
+    fprintf(stderr, "Invalid archive file\n");
+    exit( EXIT_FAILURE );
+  }
+  if ( fseeko( fp, readLong( fp ), SEEK_SET ) != 0 ) {
+    fprintf(stderr, "Invalid archive file\n");
+    exit( EXIT_FAILURE );
+  }
+
+  return fp;
+}
+
+
+/**
+ * Checks that the archive has room for the given number of index entries
+ * after the current position, so a count read from a damaged archive
+ * can't make us allocate or read more than the file holds.  Exits with an
+ * error if it doesn't.
+ *
+ * @param FILE *fp - archive file, opened for reading
+ * @param size_t count - number of entries
+ * @param size_t size - number of bytes in each entry
+ */
+static void checkRemaining( FILE *fp, size_t count, size_t size )
+{
+  off_t pos = ftello( fp );
+  bool ok = pos >= 0 && fseeko( fp, 0, SEEK_END ) == 0;
+  off_t end = ftello( fp );
+  ok = ok && end >= pos && fseeko( fp, pos, SEEK_SET ) == 0 &&
+       count <= (size_t) ( end - pos ) / size;
+  if ( !ok ) {
+    fprintf(stderr, "Invalid archive file\n");
+    exit( EXIT_FAILURE );
+  }
+}
+
+
+/**
+ * Reads a member name from the archive index into a dynamically allocated
+ * string.  The caller is responsible for freeing it.
+ *
+ * @param FILE *fp - archive file, positioned at the name
+ * @return char* name - the member name
+ */
+static char *readName( FILE *fp )
+{
+  size_t len = readInt( fp );
+  checkRemaining( fp, len, 1 );
+  char *name = (char *)malloc( len + 1 );
+  if ( fread( name, 1, len, fp ) != len ) {
+    fprintf(stderr, "Invalid archive file\n");
+    exit( EXIT_FAILURE );
+  }
+  name[ len ] = '\0';
+  return name;
+}
+
+
+/**
+ * Lists the names of the members in an archive, one per line.
+ *
+ * @param char const *aname - name of the archive file
+ */
+static void listArchive( char const *aname )
+{
+  FILE *fp = openArchive( aname );
+
+  // Skip the chunk table.
+  unsigned int storedCount = readInt( fp );
+  fseeko( fp, (off_t) storedCount * STORED_BYTES, SEEK_CUR );
+
+  unsigned int count = readInt( fp );
+  for ( unsigned int i = 0; i < count; i++ ) {
+    char *name = readName( fp );
+    printf( "%s\n", name );
+    free( name );
+    fseeko( fp, (off_t) readInt( fp ) * INT_BYTES, SEEK_CUR );
+  }
+
+  fclose( fp );
+}
+
+
+/**
+ * Extracts one member from an archive, decoding only that member's chunks.
+ *
+ * @param char const *aname - name of the archive file
+ * @param char const *member - name of the member to extract
+ * @param char const *oname - name of the output file
+ */
+static void extractArchive( char const *aname, char const *member, char const *oname )
+{
+  WordList *wordList = defaultWordList();
+  FILE *fp = openArchive( aname );
+
+  // Read the chunk table.
+  unsigned int storedCount = readInt( fp );
+  checkRemaining( fp, storedCount, STORED_BYTES );
+  Stored *stored = (Stored *)malloc( ( storedCount + 1 ) * sizeof( Stored ) );
+  for ( unsigned int i = 0; i < storedCount; i++ ) {
+    stored[ i ].offset = readLong( fp );
+    stored[ i ].codeCount = readInt( fp );
+    stored[ i ].len = readInt( fp );
+  }
+
+  // Find the member we want, skipping over the others.
+  unsigned int count = readInt( fp );
+  unsigned int i = 0;
+  for ( ; i < count; i++ ) {
+    char *name = readName( fp );
+    bool found = strcmp( name, member ) == 0;
+    free( name );
+    if ( found ) {
+      break;
+    }
+    fseeko( fp, (off_t) readInt( fp ) * INT_BYTES, SEEK_CUR );
+  }
+  if ( i == count ) {
+    fprintf(stderr, "No such member: %s\n", member);
+    exit( EXIT_FAILURE );
+  }
+
+  unsigned int chunkCount = readInt( fp );
+  checkRemaining( fp, chunkCount, INT_BYTES );
+  unsigned int *ids = (unsigned int *)malloc( ( chunkCount + 1 ) * sizeof( unsigned int ) );
+  for ( unsigned int j = 0; j < chunkCount; j++ ) {
+    ids[ j ] = readInt( fp );
+    if ( ids[ j ] >= storedCount ) {
+      fprintf(stderr, "Invalid archive file\n");
+      exit( EXIT_FAILURE );
+    }
+  }
+
+  FILE *output;
+  if (( output = fopen( oname, "w" )) == NULL ) {
+    fprintf(stderr, "Can't open file: %s\n", oname);
+    exit( EXIT_FAILURE );
+  }
+
+  char text[ MAX_CHUNK ];
+  for ( unsigned int j = 0; j < chunkCount; j++ ) {
+    Stored *chunk = stored + ids[ j ];
+    if ( !readChunk( wordList, chunk, text, fp ) ) {
+      fprintf(stderr, "Invalid archive file\n");
+      exit( EXIT_FAILURE );
+    }
+    long long start = traceClock();
+    fwrite( text, 1, chunk->len, output );
+    traceSpan( "write", start );
+  }
+
+  // Free allocated memory and close files.
+  free( stored );
+  free( ids );
+  fclose( fp );
+  fclose( output );
+}
+
+
+/**
+ * This is the main function for archive.c.  With -c, it creates an archive
+ * from the listed files, hashing with the number of threads given by -j,
+ * or one per core.  With -x, it extracts one member to the given output
+ * file.  With -t, it lists the members.  Archives always use the built-in
+ * default word list.
+ */
+int main( int argc, char *argv[] )
+{
+  // Turn on tracing, if it's requested in the environment.
+  traceInit();
+
+  // Take the thread count, if it's given.  It only goes with -c.
+  if ( argc >= 3 && strcmp( argv[ 1 ], "-j" ) == 0 ) {
+    char extra;
+    if ( sscanf( argv[ 2 ], "%d%c", &threadLimit, &extra ) != 1 || threadLimit < 1 ||
+         argc < 4 || strcmp( argv[ 3 ], "-c" ) != 0 ) {
+      fputs( USAGE, stderr );
+      exit( EXIT_FAILURE );
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
+  if ( argc >= 4 && strcmp( argv[ 1 ], "-c" ) == 0 ) {
+    createArchive( argv[ 2 ], argc - 3, argv + 3 );
+  } else if ( argc == 5 && strcmp( argv[ 1 ], "-x" ) == 0 ) {
+    extractArchive( argv[ 2 ], argv[ 3 ], argv[ 4 ] );
+  } else if ( argc == 3 && strcmp( argv[ 1 ], "-t" ) == 0 ) {
+    listArchive( argv[ 2 ] );
+  } else {
+    fputs( USAGE, stderr );
+    exit( EXIT_FAILURE );
+  }
+
+  traceFinish();
+  return EXIT_SUCCESS;
+}
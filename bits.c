@@ -9,6 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "trace.h"
 
 /** Number of bits per byte.  This isn't going to change, but it lets us give
     a good explanation instead of just the literal value, 8. */
@@ -17,6 +20,28 @@
 /** Number of bits in each code written to or read from a file. */
 #define BITS_PER_CODE 9
 
+/** Number of codes in a group.  A group of 8 codes is exactly 72 bits, so
+    the bit layout repeats every group and a group that starts on a byte
+    boundary can be packed or unpacked without any pending bits. */
+#define CODES_PER_GROUP 8
+
+/** Number of bytes holding one group of codes. */
+#define BYTES_PER_GROUP 9
+
+/** Number of groups writeCodes() and readCodes() move to or from the
+    file in each call to fwrite() or fread(). */
+#define GROUPS_PER_BUFFER 512
+
+/** Mask for the low-order bits of a code. */
+#define CODE_MASK 0x1FF
+
+/** Bit used to mark a stream, set in the padding at the end of its last
+    byte.  If the last group of codes fills its bytes exactly, there's no
+    padding, so the mark gets a byte of its own.  That leaves the file one
+    byte longer than a multiple of BYTES_PER_GROUP, which an unmarked
+    stream never is. */
+#define MARK_BIT 0x80
+
 /** Buffer space for up to 8 bits that we're not finished processing.
     We have to read/write files one or more bytes at a time, but we
     need to access this data 9 bits at a time.  While writing a file,
@@ -84,6 +109,53 @@ void flushBits( PendingBits *pending, FILE *fp )
 } 
 
 
+/** Like flushBits(), but also marks the stream by setting MARK_BIT in
+    the padding of its last byte, or in an extra byte if there's no padding.
+    @param pending pointer to storage for unwritten bits left over
+    from the most recent call to writeCode().
+    @param fp file these bits are to be written to, opened for writing.
+*/
+void flushMarked( PendingBits *pending, FILE *fp )
+{
+  if ( pending->bitCount > 0 ) {
+    fputc( pending->bits | MARK_BIT, fp );
+  } else {
+    fputc( MARK_BIT, fp );
+  }
+  pending->bits = 0;
+}
+
+
+/** Report whether a stream was finished with flushMarked().  This
+    leaves the file at the same position it was in before the call.
+    @param fp compressed file, opened for reading.
+    @return true if the stream is marked, false if it isn't or if the
+    file can't be seeked.
+*/
+bool readMark( FILE *fp )
+{
+  long pos = ftell( fp );
+  if ( pos < 0 || fseek( fp, 0, SEEK_END ) != 0 ) {
+    return false;
+  }
+  long size = ftell( fp );
+  
+  // A lone mark byte, or a mark in the padding of the last byte.
+  int extra = size < 0 ? 0 : size % BYTES_PER_GROUP;
+  bool marked = extra == 1;
+  if ( extra > 1 ) {
+    int ch = EOF;
+    if ( fseek( fp, size - 1, SEEK_SET ) == 0 ) {
+      ch = fgetc( fp );
+    }
+    marked = ch != EOF && ( ch & MARK_BIT ) != 0;
+  }
+  
+  fseek( fp, pos, SEEK_SET );
+  return marked;
+}
+
+
 /** Read and return the next 9-bit code from the given file.
     @param pending pointer to storage for left-over bits read during
     the last call to readCode().
@@ -126,4 +198,212 @@ int readCode( PendingBits *pending, FILE *fp )
   pending->bitCount--;
   
   return code;
-}
\ No newline at end of file
+}
+
+
+/** Pack a group of 8 codes into 9 bytes, using the same bit order as
+    writeCode().  The first seven codes and the low bit of the last one
+    fill a 64-bit word that's stored a byte at a time, so this doesn't
+    depend on the byte order of the machine.
+    @param codes the 8 codes to pack.
+    @param bytes storage for the 9 packed bytes.
+*/
+static void packGroup( int const *codes, unsigned char *bytes )
+{
+  uint64_t word = 0;
+  for ( int i = 0; i < CODES_PER_GROUP - 1; i++ ) {
+    word |= (uint64_t)codes[ i ] << ( i * BITS_PER_CODE );
+  }
+  word |= (uint64_t)( codes[ CODES_PER_GROUP - 1 ] & 1 ) << 63;
+
+  for ( int i = 0; i < BYTES_PER_GROUP - 1; i++ ) {
+    bytes[ i ] = word >> ( i * BITS_PER_BYTE );
+  }
+  bytes[ BYTES_PER_GROUP - 1 ] = codes[ CODES_PER_GROUP - 1 ] >> 1;
+}
+
+
+/** Unpack 9 bytes into a group of 8 codes, the reverse of packGroup().
+    @param bytes the 9 packed bytes.
+    @param codes storage for the 8 codes.
+*/
+static void unpackGroup( unsigned char const *bytes, int *codes )
+{
+  uint64_t word = 0;
+  for ( int i = 0; i < BYTES_PER_GROUP - 1; i++ ) {
+    word |= (uint64_t)bytes[ i ] << ( i * BITS_PER_BYTE );
+  }
+
+  for ( int i = 0; i < CODES_PER_GROUP - 1; i++ ) {
+    codes[ i ] = ( word >> ( i * BITS_PER_CODE ) ) & CODE_MASK;
+  }
+  codes[ CODES_PER_GROUP - 1 ] = ( word >> 63 ) | ( bytes[ BYTES_PER_GROUP - 1 ] << 1 );
+}
+
+
+/** Get ready to add more codes to the end of an existing compressed file.
+    The number of codes in the file, and so the number of bits in its last,
+    partial byte, follows from the file size.  The bits in that byte are
+    loaded into pending and the file is positioned at that byte, so the next
+    call to writeCode() rewrites it with the new code's bits added.
+    A mark left by flushMarked() is dropped, so the stream has to be
+    finished with flushMarked() again to keep it.
+    @param pending pointer to storage for unwritten bits, to be filled in.
+    @param fp compressed file, opened for update.
+    @return true if the file size is one that pack can produce.
+*/
+bool resumeBits( PendingBits *pending, FILE *fp )
+{
+  pending->bits = 0;
+  pending->bitCount = 0;
+  
+  // A file we can't seek in, like a pipe, can't be appended to.
+  if ( fseek( fp, 0, SEEK_END ) != 0 ) {
+    return false;
+  }
+  long size = ftell( fp );
+  if ( size < 0 ) {
+    return false;
+  }
+  
+  // Each whole group is 9 bytes.  A partial group of n codes takes n + 1
+  // bytes, so a single byte left over can only be a mark on its own.  New
+  // codes go right over it.
+  int extra = size % BYTES_PER_GROUP;
+  if ( extra == 0 ) {
+    return true;
+  }
+  if ( extra == 1 ) {
+    fseek( fp, size - 1, SEEK_SET );
+    return fgetc( fp ) == MARK_BIT && fseek( fp, size - 1, SEEK_SET ) == 0;
+  }
+  
+  // The low-order bits of the last byte are the pending bits; the rest is
+  // padding, and maybe a mark.
+  if ( fseek( fp, size - 1, SEEK_SET ) != 0 ) {
+    return false;
+  }
+  int ch = fgetc( fp );
+  if ( ch == EOF || fseek( fp, size - 1, SEEK_SET ) != 0 ) {
+    return false;
+  }
+  pending->bitCount = extra - 1;
+  pending->bits = ch & ( ( 1 << pending->bitCount ) - 1 );
+  
+  return true;
+}
+
+
+/** Write a sequence of 9-bit codes to the given file, with the same
+    result as calling writeCode() for each of them.  Whole groups of
+    codes are packed into memory and written together; only codes
+    before the first byte boundary and the ragged tail go through
+    writeCode().
+    @param codes array of codes to write, each between 0 and 2^9 - 1.
+    @param count number of codes in the array.
+    @param pending pointer to storage for unwritten bits, as for writeCode().
+    @param fp file we're writing to, opened for writing.
+*/
+void writeCodes( int const *codes, int count, PendingBits *pending, FILE *fp )
+{
+  unsigned char buffer[ GROUPS_PER_BUFFER * BYTES_PER_GROUP ];
+  int pos = 0;
+
+  // Get back to a byte boundary, if we're not on one already.
+  while ( pos < count && pending->bitCount != 0 ) {
+    writeCode( codes[ pos ], pending, fp );
+    pos++;
+  }
+
+  // Pack whole groups, a buffer full at a time.
+  while ( count - pos >= CODES_PER_GROUP ) {
+    long long start = traceClock();
+    int len = 0;
+    while ( count - pos >= CODES_PER_GROUP && len < GROUPS_PER_BUFFER * BYTES_PER_GROUP ) {
+      packGroup( codes + pos, buffer + len );
+      pos += CODES_PER_GROUP;
+      len += BYTES_PER_GROUP;
+    }
+    traceSpan( "bit-pack", start );
+    
+    start = traceClock();
+    fwrite( buffer, 1, len, fp );
+    traceSpan( "write", start );
+  }
+
+  // Anything left over is less than a group.
+  while ( pos < count ) {
+    writeCode( codes[ pos ], pending, fp );
+    pos++;
+  }
+}
+
+
+/** Read up to count 9-bit codes from the given file, with the same
+    result as calling readCode() until it returns -1 or count codes
+    have been read.
+    @param codes array to fill with the codes read in.
+    @param count maximum number of codes to read.
+    @param pending pointer to storage for left-over bits, as for readCode().
+    @param fp file bits are being read from, opened for reading.
+    @return number of codes read.  This is less than count only if we
+    reached the end-of-file.
+*/
+int readCodes( int *codes, int count, PendingBits *pending, FILE *fp )
+{
+  unsigned char buffer[ GROUPS_PER_BUFFER * BYTES_PER_GROUP ];
+  int pos = 0;
+  int code;
+
+  // Get back to a byte boundary, if we're not on one already.
+  while ( pos < count && pending->bitCount != 0 ) {
+    if ( ( code = readCode( pending, fp ) ) == -1 ) {
+      return pos;
+    }
+    codes[ pos++ ] = code;
+  }
+
+  // Unpack whole groups, a buffer full at a time.
+  while ( count - pos >= CODES_PER_GROUP ) {
+    int groups = ( count - pos ) / CODES_PER_GROUP;
+    if ( groups > GROUPS_PER_BUFFER ) {
+      groups = GROUPS_PER_BUFFER;
+    }
+    long long start = traceClock();
+    int len = fread( buffer, 1, groups * BYTES_PER_GROUP, fp );
+    traceSpan( "block read", start );
+    
+    start = traceClock();
+    for ( int i = 0; i + BYTES_PER_GROUP <= len; i += BYTES_PER_GROUP ) {
+      unpackGroup( buffer + i, codes + pos );
+      pos += CODES_PER_GROUP;
+    }
+    traceSpan( "bit-unpack", start );
+
+    // A short read means we're at the end of the file.  Any bytes past the
+    // last whole group hold one less code than there are bytes, followed by
+    // padding, so unpack them as a zero-filled group and keep what's real.
+    int extra = len % BYTES_PER_GROUP;
+    if ( len < groups * BYTES_PER_GROUP ) {
+      if ( extra > 1 ) {
+        unsigned char tail[ BYTES_PER_GROUP ] = { 0 };
+        int tailCodes[ CODES_PER_GROUP ];
+        memcpy( tail, buffer + len - extra, extra );
+        unpackGroup( tail, tailCodes );
+        memcpy( codes + pos, tailCodes, ( extra - 1 ) * sizeof( int ) );
+        pos += extra - 1;
+      }
+      return pos;
+    }
+  }
+
+  // Anything left over is less than a group.
+  while ( pos < count ) {
+    if ( ( code = readCode( pending, fp ) ) == -1 ) {
+      return pos;
+    }
+    codes[ pos++ ] = code;
+  }
+
+  return pos;
+}
@@ -11,6 +11,7 @@
 #define _BITS_H_
 
 #include <stdio.h>
+#include <stdbool.h>
 
 /** Number of bits per byte.  This isn't going to change, but it lets us give
     a good explanation instead of just the literal value, 8. */
@@ -19,6 +20,26 @@
 /** Number of bits in each code written to or read from a file. */
 #define BITS_PER_CODE 9
 
+/** Number of codes in a group.  A group of 8 codes is exactly 72 bits, so
+    the bit layout repeats every group and a group that starts on a byte
+    boundary can be packed or unpacked without any pending bits. */
+#define CODES_PER_GROUP 8
+
+/** Number of bytes holding one group of codes. */
+#define BYTES_PER_GROUP 9
+
+/** Number of codes pack and unpack hold in memory at a time.  This is a
+    multiple of CODES_PER_GROUP, so every block after the first one starts
+    on a byte boundary. */
+#define CODES_PER_BLOCK 4096
+
+/** Bit used to mark a stream, set in the padding at the end of its last
+    byte.  If the last group of codes fills its bytes exactly, there's no
+    padding, so the mark gets a byte of its own.  That leaves the file one
+    byte longer than a multiple of BYTES_PER_GROUP, which an unmarked
+    stream never is. */
+#define MARK_BIT 0x80
+
 /** Buffer space for up to 8 bits that we're not finished processing.
     We have to read/write files one or more bytes at a time, but we
     need to access this data 9 bits at a time.  While writing a file,
@@ -52,6 +73,22 @@ void writeCode( int code, PendingBits *pending, FILE *fp );
 */
 void flushBits( PendingBits *pending, FILE *fp );
 
+/** Like flushBits(), but also marks the stream by setting MARK_BIT in
+    the padding of its last byte, or in an extra byte if there's no padding.
+    @param pending pointer to storage for unwritten bits left over
+    from the most recent call to writeCode().
+    @param fp file these bits are to be written to, opened for writing.
+*/
+void flushMarked( PendingBits *pending, FILE *fp );
+
+/** Report whether a stream was finished with flushMarked().  This
+    leaves the file at the same position it was in before the call.
+    @param fp compressed file, opened for reading.
+    @return true if the stream is marked, false if it isn't or if the
+    file can't be seeked.
+*/
+bool readMark( FILE *fp );
+
 /** Read and return the next 9-bit code from the given file.
     @param pending pointer to storage for left-over bits read during
     the last call to readCode().
@@ -61,4 +98,42 @@ void flushBits( PendingBits *pending, FILE *fp );
 */
 int readCode( PendingBits *pending, FILE *fp );
 
+/** Get ready to add more codes to the end of an existing compressed file.
+    The number of codes in the file, and so the number of bits in its last,
+    partial byte, follows from the file size.  The bits in that byte are
+    loaded into pending and the file is positioned at that byte, so the next
+    call to writeCode() rewrites it with the new code's bits added.
+    A mark left by flushMarked() is dropped, so the stream has to be
+    finished with flushMarked() again to keep it.
+    @param pending pointer to storage for unwritten bits, to be filled in.
+    @param fp compressed file, opened for update.
+    @return true if the file size is one that pack can produce, false
+    if it isn't or if the file can't be seeked or read.
+*/
+bool resumeBits( PendingBits *pending, FILE *fp );
+
+/** Write a sequence of 9-bit codes to the given file, with the same
+    result as calling writeCode() for each of them.  Whole groups of
+    codes are packed into memory and written together; only codes
+    before the first byte boundary and the ragged tail go through
+    writeCode().
+    @param codes array of codes to write, each between 0 and 2^9 - 1.
+    @param count number of codes in the array.
+    @param pending pointer to storage for unwritten bits, as for writeCode().
+    @param fp file we're writing to, opened for writing.
+*/
+void writeCodes( int const *codes, int count, PendingBits *pending, FILE *fp );
+
+/** Read up to count 9-bit codes from the given file, with the same
+    result as calling readCode() until it returns -1 or count codes
+    have been read.
+    @param codes array to fill with the codes read in.
+    @param count maximum number of codes to read.
+    @param pending pointer to storage for left-over bits, as for readCode().
+    @param fp file bits are being read from, opened for reading.
+    @return number of codes read.  This is less than count only if we
+    reached the end-of-file.
+*/
+int readCodes( int *codes, int count, PendingBits *pending, FILE *fp );
+
 #endif
@@ -0,0 +1,115 @@
+/** 
+ * This file contains the case folding stage for pack and unpack.  Folding
+ * the text to lower case lets capitalized words match the lower case
+ * words in the word list, at the cost of one marker code per word.
+ *  
+ * @file fold.c
+ * @author Louis Warner
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "fold.h"
+
+/** Unfolding state, when the next letter is upper case. */
+#define FOLD_CAP 1
+
+/** Unfolding state, inside an upper case run of letters. */
+#define FOLD_UPPER 2
+
+
+/**
+ * Return a folded copy of the given text, with every upper case letter
+ * changed to lower case and marked with CAP_MARK or UPPER_MARK.
+ *
+ * @param char const *text - null terminated text to fold
+ * @return char* folded - dynamically allocated, null terminated folded text
+ */
+char *foldCase( char const *text )
+{
+  // At worst, every character gets a marker.
+  int len = strlen( text );
+  char *folded = (char *)malloc( ( 2 * len + 1 ) * sizeof( char ) );
+  int out = 0;
+  
+  int pos = 0;
+  while ( pos < len ) {
+    if ( !isalpha( (unsigned char) text[ pos ] ) ) {
+      folded[ out++ ] = text[ pos++ ];
+      continue;
+    }
+    
+    // Find the run of letters starting here, and count the upper case ones.
+    int end = pos;
+    int upper = 0;
+    while ( end < len && isalpha( (unsigned char) text[ end ] ) ) {
+      if ( isupper( (unsigned char) text[ end ] ) ) {
+        upper++;
+      }
+      end++;
+    }
+    
+    if ( upper > 1 && upper == end - pos && end < len ) {
+      // All upper case, one marker for the whole run.  A run at the very end
+      // is marked a letter at a time instead, so text appended later can't
+      // look like more of the run.
+      folded[ out++ ] = UPPER_MARK;
+    } else if ( upper == 1 && isupper( (unsigned char) text[ pos ] ) ) {
+      // Capitalized, one marker for the first letter.
+      folded[ out++ ] = CAP_MARK;
+    } else if ( upper > 0 ) {
+      // Mixed case, mark each upper case letter.
+      for ( ; pos < end; pos++ ) {
+        if ( isupper( (unsigned char) text[ pos ] ) ) {
+          folded[ out++ ] = CAP_MARK;
+        }
+        folded[ out++ ] = tolower( (unsigned char) text[ pos ] );
+      }
+      continue;
+    }
+    
+    for ( ; pos < end; pos++ ) {
+      folded[ out++ ] = tolower( (unsigned char) text[ pos ] );
+    }
+  }
+  
+  folded[ out ] = '\0';
+  return folded;
+}
+
+
+/**
+ * Restore the capitalization of folded text, in place.
+ *
+ * @param char *text - folded text, not necessarily null terminated
+ * @param int len - number of characters in the text
+ * @param int *state - unfolding state, starting at FOLD_NONE
+ * @return int out - number of characters of unfolded text
+ */
+int unfoldCase( char *text, int len, int *state )
+{
+  int out = 0;
+  for ( int pos = 0; pos < len; pos++ ) {
+    char ch = text[ pos ];
+    if ( ch == CAP_MARK ) {
+      *state = FOLD_CAP;
+    } else if ( ch == UPPER_MARK ) {
+      *state = FOLD_UPPER;
+    } else if ( islower( (unsigned char) ch ) ) {
+      if ( *state == FOLD_CAP ) {
+        *state = FOLD_NONE;
+        ch = toupper( (unsigned char) ch );
+      } else if ( *state == FOLD_UPPER ) {
+        ch = toupper( (unsigned char) ch );
+      }
+      text[ out++ ] = ch;
+    } else {
+      // Anything else ends a marked run.
+      *state = FOLD_NONE;
+      text[ out++ ] = ch;
+    }
+  }
+  return out;
+}
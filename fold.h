@@ -0,0 +1,46 @@
+/** 
+ * Header file for the fold.c component, with functions for folding text
+ * to lower case before it's compressed, and restoring the original
+ * capitalization after it's uncompressed.
+ *  
+ * @file fold.h
+ * @author Louis Warner
+*/
+
+
+#ifndef _FOLD_H_
+#define _FOLD_H_
+
+/** Marker in folded text, meaning the next letter is upper case.  Folded
+    text has no other upper case letters, so the single-character code for
+    this letter is free to use as an escape. */
+#define CAP_MARK 'C'
+
+/** Marker in folded text, meaning the whole run of letters after it is
+    upper case. */
+#define UPPER_MARK 'U'
+
+/** Unfolding state, for text that isn't inside a marked letter or run. */
+#define FOLD_NONE 0
+
+/** Return a folded copy of the given text, with every upper case letter
+    changed to lower case and marked with CAP_MARK or UPPER_MARK.  A
+    capitalized word or an all upper case word needs just one marker.
+    The caller is responsible for freeing the returned string.
+    @param text null terminated text to fold.
+    @return dynamically allocated, null terminated folded text.
+*/
+char *foldCase( char const *text );
+
+/** Restore the capitalization of folded text, in place.  The markers are
+    removed, so the result may be shorter than the input.  Folded text can
+    be unfolded a piece at a time, since any marker that applies to the
+    next piece is remembered in state.
+    @param text folded text, not necessarily null terminated.
+    @param len number of characters in the text.
+    @param state unfolding state, starting at FOLD_NONE.
+    @return number of characters of unfolded text.
+*/
+int unfoldCase( char *text, int len, int *state );
+
+#endif
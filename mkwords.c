@@ -0,0 +1,107 @@
+/** 
+ * This program generates the C source for the default word list, so
+ * pack and unpack don't have to read and sort words.txt every time
+ * they run.  It takes two command line arguments, the word file to
+ * read and the C source file to write.
+ *  
+ * @file mkwords.c
+ * @author Louis Warner
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "wordlist.h"
+
+/**
+ * Writes the given word out as a C string literal, escaping any characters
+ * that can't appear in the literal as-is.  Question marks are escaped too,
+ * so a word can't accidentally turn into a trigraph.
+ *
+ * @param char const *word - word to write out
+ * @param FILE *fp - file we're writing to, opened for writing
+ */
+void writeLiteral( char const *word, FILE *fp )
+{
+  fputc( '"', fp );
+  for ( int i = 0; word[ i ]; i++ ) {
+    switch ( word[ i ] ) {
+    case '\t':
+      fprintf( fp, "\\t" );
+      break;
+    case '\n':
+      fprintf( fp, "\\n" );
+      break;
+    case '\r':
+      fprintf( fp, "\\r" );
+      break;
+    case '"':
+    case '\\':
+    case '?':
+      fprintf( fp, "\\%c", word[ i ] );
+      break;
+    default:
+      fputc( word[ i ], fp );
+    }
+  }
+  fputc( '"', fp );
+}
+
+/**
+ * This is the main function for mkwords.c.  It reads and sorts the word list
+ * the same way pack and unpack do, then writes it out as a table that can be
+ * compiled into both programs.
+ */
+int main( int argc, char *argv[] )
+{
+  FILE *output;
+
+  if ( argc != 3 )
+  {
+      fprintf(stderr, "usage: mkwords <word_file.txt> <output.c>\n");
+      exit( EXIT_FAILURE );
+  }
+
+  // Read the whole list first, so a bad word file doesn't leave a partial output file.
+  WordList *wordList = readWordList( argv[ 1 ] );
+
+  if((output = fopen( argv[ 2 ], "w" ))  == NULL )
+  {
+    fprintf(stderr, "Can't open file: %s\n", argv[ 2 ]);
+    fprintf(stderr, "usage: mkwords <word_file.txt> <output.c>\n");
+    exit( EXIT_FAILURE );
+  }
+
+  fprintf( output, "/**\n" );
+  fprintf( output, " * Default word list, generated from %s by mkwords.  Don't edit.\n", argv[ 1 ] );
+  fprintf( output, " *\n" );
+  fprintf( output, " * @file %s\n", argv[ 2 ] );
+  fprintf( output, "*/\n\n" );
+  fprintf( output, "#include \"wordlist.h\"\n\n" );
+
+  // The words are already sorted, so the index of each entry is its code.
+  fprintf( output, "/** Sorted words, indexed by code. */\n" );
+  fprintf( output, "static Word defaultWords[ %d ] = {\n", wordList->len );
+  for ( int i = 0; i < wordList->len; i++ ) {
+    fprintf( output, "  " );
+    writeLiteral( wordList->words[ i ], output );
+    fprintf( output, ",\n" );
+  }
+  fprintf( output, "};\n\n" );
+
+  // A capacity of zero marks the list as static, so freeWordList() leaves it alone.
+  fprintf( output, "/** Word list over the table above. */\n" );
+  fprintf( output, "static WordList defaultList = { %d, 0, defaultWords };\n\n", wordList->len );
+
+  fprintf( output, "WordList *defaultWordList( void )\n" );
+  fprintf( output, "{\n" );
+  fprintf( output, "  return &defaultList;\n" );
+  fprintf( output, "}\n" );
+
+  freeWordList( wordList );
+  fclose( output );
+
+  return EXIT_SUCCESS;
+}
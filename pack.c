@@ -12,9 +12,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include "wordlist.h"
 #include "bits.h"
+#include "fold.h"
+#include "trace.h"
 
 
 /**
@@ -31,6 +34,7 @@
   // Allocate a string with a small, initial capacity.
   int capacity = 5;
   char *buffer = (char *)malloc( (capacity + 1) * sizeof(char)); 
+  buffer[0] = '\0';
   unsigned char next;
   int len = 0;
   next = fgetc(fp);
@@ -63,29 +67,53 @@
 
 /**
  * This is the main function for pack.c, it takes either 2 or 3 command line arguments.
- * If it is given only two arguments, it will use the default word list in the file "words.txt".
+ * If it is given only two arguments, it will use the default word list built in from "words.txt".
  * A third argument will switch the word list to whatever the user specified file is.
+ * With the --append option in front, the input is added to the end of an existing
+ * compressed file instead of replacing it.  With the --fold option, the input is
+ * folded to lower case before it's compressed, and the stream is marked so unpack
+ * knows to restore the capitalization.
  */
 int main( int argc, char *argv[] )
 {
-  char *wordFile = "words.txt";
-
-  // Check command-line arguments and open the input file.
+  // Check command-line options and arguments.
   FILE *input;
   FILE *output;
+  bool append = false;
+  bool fold = false;
+  while ( argc > 1 && strncmp( argv[ 1 ], "--", 2 ) == 0 )
+  {
+    if ( strcmp( argv[ 1 ], "--append" ) == 0 ) {
+      append = true;
+    } else if ( strcmp( argv[ 1 ], "--fold" ) == 0 ) {
+      fold = true;
+    } else {
+      fprintf(stderr, "usage: pack [--append] [--fold] <input.txt> <compressed.raw> [word_file.txt]\n");
+      exit( EXIT_FAILURE );
+    }
+    argc--;
+    argv++;
+  }
+  
   if ( argc != 3 && argc != 4 )
   {
-      fprintf(stderr, "usage: pack <input.txt> <compressed.raw> [word_file.txt]\n");
+      fprintf(stderr, "usage: pack [--append] [--fold] <input.txt> <compressed.raw> [word_file.txt]\n");
       exit( EXIT_FAILURE );
   }
   
-  // If the user provides a wordfile, replace the default wordfile.
+  // Turn on tracing, if it's requested in the environment.
+  traceInit();
+  
+  // If the user provides a wordfile, use it instead of the built-in default list.
+  long long start = traceClock();
+  WordList *wordList;
   if (argc == 4)
   {
-    wordFile = argv[ 3 ];
+    wordList = readWordList( argv[ 3 ] );
+  } else {
+    wordList = defaultWordList();
   }
-  
-  WordList *wordList = readWordList( wordFile );
+  traceSpan( "dictionary load", start );
 
 #ifdef DEBUG
   // Report the entire contents of the word list, once it's built.
@@ -96,45 +124,98 @@ int main( int argc, char *argv[] )
 #endif
 
   // Check for valid input and output files.
+  PendingBits pending = { 0, 0 };
   if((input = fopen( argv[ 1 ], "r" ) ) == NULL ) 
   {
     fprintf(stderr, "Can't open file: %s\n", argv[ 1 ]);
-    fprintf(stderr, "usage: pack <input.txt> <compressed.raw> [word_file.txt]\n");
+    fprintf(stderr, "usage: pack [--append] [--fold] <input.txt> <compressed.raw> [word_file.txt]\n");
     exit( EXIT_FAILURE );
   }
-  if((output = fopen( argv[ 2 ], "w" ))  == NULL )
+  // When appending, open the existing file for update, or create it if it isn't there yet.
+  // If it's there but can't be opened for update, leave it alone.
+  if ( append && ( output = fopen( argv[ 2 ], "r+" ) ) != NULL )
+  {
+    // Once there's something in the file, its mark decides whether we fold case.
+    fseek( output, 0, SEEK_END );
+    if ( ftell( output ) > 0 )
+    {
+      bool marked = readMark( output );
+      if ( fold && !marked )
+      {
+        fprintf(stderr, "Can't fold case when appending to unfolded file: %s\n", argv[ 2 ]);
+        exit( EXIT_FAILURE );
+      }
+      fold = marked;
+    }
+
+    // Pick up the pending bits from the last, partial byte, so new codes go right after the old ones.
+    if ( !resumeBits( &pending, output ) )
+    {
+      fprintf(stderr, "Invalid compressed file: %s\n", argv[ 2 ]);
+      exit( EXIT_FAILURE );
+    }
+  }
+  else if ( ( append && errno != ENOENT ) || ( output = fopen( argv[ 2 ], "w" ) ) == NULL )
   {
     fprintf(stderr, "Can't open file: %s\n", argv[ 2 ]);
-    fprintf(stderr, "usage: pack <input.txt> <compressed.raw> [word_file.txt]\n");
+    fprintf(stderr, "usage: pack [--append] [--fold] <input.txt> <compressed.raw> [word_file.txt]\n");
     exit( EXIT_FAILURE );
   }
 
   // Read the contents of the whole file into one big buffer.  This could be more
   // efficient, but it simplifies the rest of the program.
+  start = traceClock();
   char *buffer = readFile( input );
+  traceSpan( "block read", start );
 
-  // Write out codes for everything in the buffer.
+  // Fold the text to lower case, if requested.
+  if ( fold ) {
+    start = traceClock();
+    char *folded = foldCase( buffer );
+    free( buffer );
+    buffer = folded;
+    traceSpan( "fold", start );
+  }
+
+  // Write out codes for everything in the buffer, a block of codes at a time.
   int pos = 0;
-  PendingBits pending = { 0, 0 };
+  int codes[ CODES_PER_BLOCK ];
+  int count = 0;
+  start = traceClock();
   while ( buffer[ pos ] ) {
     // Get the next code.
     int code = bestCode( wordList, buffer + pos );
 #ifdef DEBUG
     printf( "%d <- %s\n", code, wordList->words[ code ] );
 #endif
-    // Write it out and move ahead by the number of characters we just encoded.
-    writeCode( code, &pending, output );
+    // Save it and move ahead by the number of characters we just encoded.
+    codes[ count++ ] = code;
     pos += strlen( wordList->words[ code ] );
+
+    // Write out the block once it's full.
+    if ( count == CODES_PER_BLOCK ) {
+      traceSpan( "match", start );
+      writeCodes( codes, count, &pending, output );
+      count = 0;
+      start = traceClock();
+    }
   }
+  traceSpan( "match", start );
+  writeCodes( codes, count, &pending, output );
 
-  // Write out any remaining bits in the last, partial byte.
-  flushBits( &pending, output );
+  // Write out any remaining bits in the last, partial byte, marking folded text.
+  if ( fold ) {
+    flushMarked( &pending, output );
+  } else {
+    flushBits( &pending, output );
+  }
 
   //Free remaining allocated memory and close the input and output files.
   freeWordList(wordList);
   free(buffer);
   fclose(input);
   fclose(output);
+  traceFinish();
 
   return EXIT_SUCCESS;
 }
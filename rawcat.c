@@ -0,0 +1,55 @@
+/** 
+ * Helpful program to print the text in a compressed file to standard
+ * output.  It reads the file through the stdio stream from fopenPacked(),
+ * a character at a time with getc(), so it's also a check on that adapter.
+ * Unlike fgets(), getc() passes along all the text before a read error.
+ *  
+ * @file rawcat.c
+ * @author Louis Warner
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wordlist.h"
+#include "reader.h"
+
+int main( int argc, char *argv[] )
+{
+  if ( argc != 2 && argc != 3 )
+  {
+      fprintf(stderr, "usage: rawcat <compressed.raw> [word_file.txt]\n");
+      exit( EXIT_FAILURE );
+  }
+  
+  WordList *wordList;
+  if ( argc == 3 )
+  {
+    wordList = readWordList( argv[ 2 ] );
+  } else {
+    wordList = defaultWordList();
+  }
+  
+  FILE *input;
+  if((input = fopenPacked( argv[ 1 ], wordList ) ) == NULL ) 
+  {
+    fprintf(stderr, "Can't open file: %s\n", argv[ 1 ]);
+    exit( EXIT_FAILURE );
+  }
+  
+  // Copy the text, like any other stdio stream.
+  int ch;
+  while ( ( ch = getc( input ) ) != EOF ) {
+    putchar( ch );
+  }
+  
+  if ( ferror( input ) ) {
+    fprintf(stderr, "Invalid compressed file: %s\n", argv[ 1 ]);
+    exit( EXIT_FAILURE );
+  }
+  
+  fclose( input );
+  freeWordList( wordList );
+  
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/** 
+ * This file provides support for reading the text in a compressed file
+ * a little at a time.  It decodes codes lazily, a block at a time, as
+ * the caller asks for more text.
+ *  
+ * @file reader.c
+ * @author Louis Warner
+*/
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "reader.h"
+#include "fold.h"
+
+/**
+ * Makes sure the reader has a word to read from, reading the next block of
+ * codes from the file if the current one is used up.  A code past the end
+ * of the word list sets the reader's error flag.
+ *
+ * @param Reader *reader - reader that needs more text
+ * @return bool more - false if we're at the end of the text or hit an error
+ */
+static bool nextWord( Reader *reader )
+{
+  while ( *reader->word == '\0' ) {
+    if ( reader->error ) {
+      return false;
+    }
+    if ( reader->next == reader->count ) {
+      reader->count = readCodes( reader->codes, CODES_PER_BLOCK, &reader->pending, reader->fp );
+      reader->next = 0;
+      if ( reader->count == 0 ) {
+        return false;
+      }
+    }
+    int code = reader->codes[ reader->next++ ];
+    if ( code >= reader->wordList->len ) {
+      reader->error = true;
+      return false;
+    }
+    reader->word = reader->wordList->words[ code ];
+  }
+  return true;
+}
+
+
+/**
+ * Open a compressed file for reading.
+ *
+ * @param char const *fname - name of the compressed file
+ * @param WordList *wordList - word list the file was compressed with
+ * @return Reader *reader - a new reader, or NULL if the file can't be opened
+ */
+Reader *openReader( char const *fname, WordList *wordList )
+{
+  FILE *fp;
+  if (( fp = fopen( fname, "r" )) == NULL ) {
+    return NULL;
+  }
+  
+  Reader *reader = (Reader *) malloc( sizeof( Reader ) );
+  reader->fp = fp;
+  reader->wordList = wordList;
+  reader->pending.bits = 0;
+  reader->pending.bitCount = 0;
+  reader->count = 0;
+  reader->next = 0;
+  reader->word = "";
+  reader->folded = readMark( fp );
+  reader->foldState = FOLD_NONE;
+  reader->error = false;
+  
+  return reader;
+}
+
+
+/**
+ * Read up to size characters of text.  The text isn't null terminated.
+ *
+ * @param Reader *reader - reader to get text from
+ * @param char *buffer - storage for the text
+ * @param size_t size - maximum number of characters to read
+ * @return long len - number of characters read, zero at the end of the text,
+ * or -1 for a code that isn't in the word list.  Text before the bad code is
+ * returned first, and -1 comes on the next call.
+ */
+long readText( Reader *reader, char *buffer, size_t size )
+{
+  size_t len = 0;
+  
+  // Copy as much of each word as fits.  Unfolding can drop characters, so
+  // keep going until the buffer is actually full.
+  while ( len < size && nextWord( reader ) ) {
+    size_t n = strlen( reader->word );
+    if ( n > size - len ) {
+      n = size - len;
+    }
+    memcpy( buffer + len, reader->word, n );
+    reader->word += n;
+    if ( reader->folded ) {
+      n = unfoldCase( buffer + len, n, &reader->foldState );
+    }
+    len += n;
+  }
+  
+  return reader->error && len == 0 ? -1 : (long) len;
+}
+
+
+/**
+ * Read the next line of text, like fgets().  Reading stops after a newline
+ * or when the buffer is full, and the text is null terminated.
+ *
+ * @param Reader *reader - reader to get text from
+ * @param char *buffer - storage for the line
+ * @param int size - capacity of the buffer, including the null terminator
+ * @return int len - length of the text read, zero at the end of the text,
+ * or -1 for a code that isn't in the word list.  Text before the bad code is
+ * returned first, and -1 comes on the next call.
+ */
+int readLine( Reader *reader, char *buffer, int size )
+{
+  int len = 0;
+  
+  // Copy a character at a time, so we can stop right after a newline.
+  while ( len < size - 1 && nextWord( reader ) ) {
+    char ch = *reader->word++;
+    if ( reader->folded && unfoldCase( &ch, 1, &reader->foldState ) == 0 ) {
+      continue;
+    }
+    buffer[ len++ ] = ch;
+    if ( ch == '\n' ) {
+      break;
+    }
+  }
+  
+  if ( size > 0 ) {
+    buffer[ len ] = '\0';
+  }
+  return reader->error && len == 0 ? -1 : len;
+}
+
+
+/**
+ * Close the compressed file and free the reader.
+ *
+ * @param Reader *reader - reader to close
+ */
+void closeReader( Reader *reader )
+{
+  fclose( reader->fp );
+  free( reader );
+}
+
+#ifdef __linux__
+/**
+ * Read function for the stdio stream from fopenPacked().
+ *
+ * @param void *cookie - reader for the stream
+ * @param char *buffer - storage for the text
+ * @param size_t size - maximum number of characters to read
+ * @return ssize_t len - number of characters read, zero at the end of the text,
+ * or -1 to set the error indicator on the stream
+ */
+static ssize_t cookieRead( void *cookie, char *buffer, size_t size )
+{
+  return readText( (Reader *) cookie, buffer, size );
+}
+
+
+/**
+ * Close function for the stdio stream from fopenPacked().
+ *
+ * @param void *cookie - reader for the stream
+ * @return int status - always zero
+ */
+static int cookieClose( void *cookie )
+{
+  closeReader( (Reader *) cookie );
+  return 0;
+}
+
+
+/**
+ * Open a compressed file as a read-only stdio stream.
+ *
+ * @param char const *fname - name of the compressed file
+ * @param WordList *wordList - word list the file was compressed with
+ * @return FILE *fp - a new stream, or NULL if the file can't be opened
+ */
+FILE *fopenPacked( char const *fname, WordList *wordList )
+{
+  Reader *reader = openReader( fname, wordList );
+  if ( reader == NULL ) {
+    return NULL;
+  }
+  
+  cookie_io_functions_t functions = { cookieRead, NULL, NULL, cookieClose };
+  FILE *fp = fopencookie( reader, "r", functions );
+  if ( fp == NULL ) {
+    closeReader( reader );
+  }
+  return fp;
+}
+#endif
@@ -0,0 +1,105 @@
+/** 
+ * Header file for the reader.c component, with functions for reading the
+ * text in a compressed file a little at a time, without unpacking the
+ * whole thing first.
+ *  
+ * @file reader.h
+ * @author Louis Warner
+*/
+
+
+#ifndef _READER_H_
+#define _READER_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "wordlist.h"
+#include "bits.h"
+
+/** State for reading text from a compressed file.  Codes are read a block
+    at a time, and each one is only turned back into text when the caller
+    gets to it, so memory use doesn't depend on the size of the file. */
+typedef struct {
+  /** Compressed file we're reading from. */
+  FILE *fp;
+
+  /** Word list the file was compressed with. */
+  WordList *wordList;
+
+  /** Left-over bits from the last block of codes. */
+  PendingBits pending;
+
+  /** Block of codes read from the file, but not all turned into text yet. */
+  int codes[ CODES_PER_BLOCK ];
+
+  /** Number of codes in the block. */
+  int count;
+
+  /** Index of the next code in the block to turn into text. */
+  int next;
+
+  /** Characters from the current word that the caller hasn't read yet. */
+  char const *word;
+
+  /** True if the stream is marked as case folded, so the text has to be
+      unfolded as it's read. */
+  bool folded;
+
+  /** Unfolding state, carried from one piece of text to the next. */
+  int foldState;
+
+  /** True if we've read a code that isn't in the word list. */
+  bool error;
+} Reader;
+
+/** Open a compressed file for reading.  If pack folded the text to
+    lower case, the reader restores the original capitalization.
+    @param fname name of the compressed file.
+    @param wordList word list the file was compressed with.  It must stay
+    around until the reader is closed.
+    @return a new reader, or NULL if the file can't be opened.
+*/
+Reader *openReader( char const *fname, WordList *wordList );
+
+/** Read up to size characters of text.  The text isn't null terminated.
+    @param reader reader to get text from.
+    @param buffer storage for the text.
+    @param size maximum number of characters to read.
+    @return number of characters read, zero at the end of the text, or -1
+    if the file has a code that isn't in the word list.  Any text before
+    the bad code is returned first, and -1 comes on the next call.
+*/
+long readText( Reader *reader, char *buffer, size_t size );
+
+/** Read the next line of text, like fgets().  Reading stops after a
+    newline or when the buffer is full, and the text is null terminated.
+    @param reader reader to get text from.
+    @param buffer storage for the line.
+    @param size capacity of the buffer, including room for the null terminator.
+    @return length of the text read, zero at the end of the text, or -1
+    if the file has a code that isn't in the word list.  Any text before
+    the bad code is returned first, and -1 comes on the next call.
+*/
+int readLine( Reader *reader, char *buffer, int size );
+
+/** Close the compressed file and free the reader.  Any text that wasn't
+    read is never decoded.
+    @param reader reader to close.
+*/
+void closeReader( Reader *reader );
+
+#ifdef __linux__
+/** Open a compressed file as a read-only stdio stream, so code that works
+    with a FILE * can read the text without knowing it's compressed.
+    Closing the stream closes the underlying reader.  A code that isn't
+    in the word list sets the error indicator on the stream.
+    @param fname name of the compressed file.
+    @param wordList word list the file was compressed with.  It must stay
+    around until the stream is closed.
+    @return a new stream, or NULL if the file can't be opened.
+*/
+FILE *fopenPacked( char const *fname, WordList *wordList );
+#endif
+
+#endif
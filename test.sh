@@ -168,6 +168,339 @@ echo "Test 11: ./unpack not-enough-arguments > stdout.txt 2> stderr.txt"
 STATUS=$?
 checkerror 11 $STATUS
 
+# The default word list is built in, so running from another directory should still work.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 12: (cd /tmp && pack input_4.txt compressed.raw && unpack compressed.raw output.txt)"
+HERE=`pwd`
+( cd /tmp && $HERE/pack $HERE/input_4.txt $HERE/compressed.raw && $HERE/unpack $HERE/compressed.raw $HERE/output.txt ) > stdout.txt 2> stderr.txt
+STATUS=$?
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 12 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! diff -q expected_4.raw compressed.raw >/dev/null 2>&1 || ! diff -q input_4.txt output.txt >/dev/null 2>&1
+then
+    echo "**** Test 12 FAILED - output didn't match when run from another directory"
+    FAIL=1
+else
+    echo "Test 12 PASS"
+fi
+
+# Tracing shouldn't change the output, and should write a Chrome trace file.
+rm -f compressed.raw output.txt stdout.txt stderr.txt trace.json
+echo "Test 13: PACK_TRACE=trace.json ./pack input_4.txt compressed.raw > stdout.txt 2> stderr.txt"
+PACK_TRACE=trace.json ./pack input_4.txt compressed.raw > stdout.txt 2> stderr.txt
+STATUS=$?
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 13 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! diff -q expected_4.raw compressed.raw >/dev/null 2>&1
+then
+    echo "**** Test 13 FAILED - compressed output didin't match expected output"
+    FAIL=1
+elif ! grep -q '^{"traceEvents":\[' trace.json || ! grep -q '"name":"match"' trace.json
+then
+    echo "**** Test 13 FAILED - trace.json isn't a trace of the match step"
+    FAIL=1
+else
+    echo "Test 13 PASS"
+fi
+rm -f trace.json
+
+# Appending to a compressed file should unpack to the inputs, one after the other.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 14: ./pack --append input_N.txt compressed.raw, for N = 1, 4, 2, 3"
+for TEST_NO in 1 4 2 3
+do
+    ./pack --append input_$TEST_NO.txt compressed.raw >> stdout.txt 2>> stderr.txt
+done
+./unpack compressed.raw output.txt >> stdout.txt 2>> stderr.txt
+if ! cat input_1.txt input_4.txt input_2.txt input_3.txt | diff -q - output.txt >/dev/null 2>&1
+then
+    echo "**** Test 14 FAILED - uncompressed output didin't match appended inputs"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 14 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 14 PASS"
+fi
+
+# Unpacking just the first few lines should match the start of the original.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 15: ./unpack --lines 20 compressed.raw output.txt > stdout.txt 2> stderr.txt"
+./pack input_5.txt compressed.raw > stdout.txt 2> stderr.txt
+./unpack --lines 20 compressed.raw output.txt >> stdout.txt 2>> stderr.txt
+STATUS=$?
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 15 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! head -n 20 input_5.txt | diff -q - output.txt >/dev/null 2>&1
+then
+    echo "**** Test 15 FAILED - uncompressed output didin't match the first 20 lines of input"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 15 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 15 PASS"
+fi
+
+# An archive should store a duplicate file's chunks only once, and extract each member back to the original.
+rm -f compressed.raw output.txt stdout.txt stderr.txt test.pka copy_5.txt
+echo "Test 16: ./archive -c test.pka input_4.txt input_5.txt copy_5.txt, then ./archive -x each member"
+cp input_5.txt copy_5.txt
+./pack input_5.txt compressed.raw
+./archive -c test.pka input_4.txt input_5.txt copy_5.txt > stdout.txt 2> stderr.txt
+STATUS=$?
+RESULT=0
+for MEMBER in input_4.txt input_5.txt copy_5.txt
+do
+    ./archive -x test.pka $MEMBER output.txt >> stdout.txt 2>> stderr.txt
+    diff -q $MEMBER output.txt >/dev/null 2>&1 || RESULT=1
+done
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 16 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif [ $RESULT -ne 0 ]
+then
+    echo "**** Test 16 FAILED - extracted member didn't match original file"
+    FAIL=1
+elif [ `wc -c < test.pka` -ge `expr 2 \* \`wc -c < compressed.raw\`` ]
+then
+    echo "**** Test 16 FAILED - duplicate file wasn't deduplicated"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 16 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 16 PASS"
+fi
+rm -f test.pka copy_5.txt
+
+# Folding case should unpack to the original text, and compress text with capitals better.
+rm -f compressed.raw output.txt stdout.txt stderr.txt folded.raw
+echo "Test 17: ./pack --fold input_6.txt folded.raw > stdout.txt 2> stderr.txt"
+./pack input_6.txt compressed.raw
+./pack --fold input_6.txt folded.raw > stdout.txt 2> stderr.txt
+STATUS=$?
+./unpack folded.raw output.txt >> stdout.txt 2>> stderr.txt
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 17 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! diff -q input_6.txt output.txt >/dev/null 2>&1
+then
+    echo "**** Test 17 FAILED - uncompressed output didin't match original input"
+    FAIL=1
+elif [ `wc -c < folded.raw` -ge `wc -c < compressed.raw` ]
+then
+    echo "**** Test 17 FAILED - folded output wasn't smaller"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 17 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 17 PASS"
+fi
+rm -f folded.raw
+
+# Reading through the fopenPacked() stdio stream should give back the original text, folded or not.
+rm -f compressed.raw output.txt stdout.txt stderr.txt folded.raw
+echo "Test 18: ./rawcat compressed.raw > output.txt 2> stderr.txt"
+./pack input_5.txt compressed.raw
+./pack --fold input_6.txt folded.raw
+./rawcat compressed.raw > output.txt 2> stderr.txt
+STATUS=$?
+./rawcat folded.raw > stdout.txt 2>> stderr.txt
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 18 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! diff -q input_5.txt output.txt >/dev/null 2>&1 || ! diff -q input_6.txt stdout.txt >/dev/null 2>&1
+then
+    echo "**** Test 18 FAILED - text read through the stdio stream didn't match original input"
+    FAIL=1
+elif [ -s stderr.txt ]
+then
+    echo "**** Test 18 FAILED - shouldn't print anything to stderr"
+    FAIL=1
+else
+    echo "Test 18 PASS"
+fi
+rm -f folded.raw
+
+# Codes past the end of a shorter word list should be reported, not read past the list.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 19: ./unpack compressed.raw output.txt shortlist_19.txt > stdout.txt 2> stderr.txt"
+./pack input_5.txt compressed.raw
+./unpack compressed.raw output.txt shortlist_19.txt > stdout.txt 2> stderr.txt
+STATUS=$?
+checkerror 19 $STATUS
+
+# Many small, nearly identical members should be hashed together on several threads, not one
+# at a time on the main thread, and give the same archive as one thread.
+rm -rf output.txt stdout.txt stderr.txt test.pka single.pka snap_20 trace.json
+echo "Test 20: PACK_TRACE=trace.json ./archive -j 4 -c test.pka snap_20/*.txt, then ./archive -x each member"
+mkdir snap_20
+I=1
+while [ $I -le 40 ]
+do
+    ( cat input_6.txt; echo "snapshot $I" ) > snap_20/s$I.txt
+    I=`expr $I + 1`
+done
+PACK_TRACE=trace.json ./archive -j 4 -c test.pka snap_20/*.txt > stdout.txt 2> stderr.txt
+STATUS=$?
+./archive -j 1 -c single.pka snap_20/*.txt >> stdout.txt 2>> stderr.txt
+RESULT=0
+for MEMBER in snap_20/*.txt
+do
+    ./archive -x test.pka $MEMBER output.txt >> stdout.txt 2>> stderr.txt
+    diff -q $MEMBER output.txt >/dev/null 2>&1 || RESULT=1
+done
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 20 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif [ $RESULT -ne 0 ]
+then
+    echo "**** Test 20 FAILED - extracted member didn't match original file"
+    FAIL=1
+elif ! cmp -s test.pka single.pka
+then
+    echo "**** Test 20 FAILED - archive depends on the number of threads"
+    FAIL=1
+elif [ `grep -c '"name":"hash"' trace.json` -lt 2 ] || grep -q '"name":"hash"[^}]*"tid":0,' trace.json
+then
+    echo "**** Test 20 FAILED - chunks weren't hashed on worker threads"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 20 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 20 PASS"
+fi
+rm -rf test.pka single.pka snap_20 trace.json
+
+# Eight codes fill nine bytes exactly, so a folded file with a multiple of eight codes is marked
+# with a byte of its own.  Appending to it should find the mark, keep folding case, and unpack to
+# all the parts, one after the other.
+rm -f compressed.raw output.txt stdout.txt stderr.txt fold_21.txt
+echo "Test 21: ./pack --fold fold_21.txt compressed.raw, then ./pack --append input_6.txt and ./pack --append --fold input_5.txt"
+printf '12345678' > fold_21.txt
+./pack --fold fold_21.txt compressed.raw > stdout.txt 2> stderr.txt
+STATUS=$?
+SIZE=`wc -c < compressed.raw`
+./pack --append input_6.txt compressed.raw >> stdout.txt 2>> stderr.txt
+./pack --append --fold input_5.txt compressed.raw >> stdout.txt 2>> stderr.txt
+APPEND_STATUS=$?
+./unpack compressed.raw output.txt >> stdout.txt 2>> stderr.txt
+if [ $STATUS -ne 0 ] || [ $APPEND_STATUS -ne 0 ]
+then
+    echo "**** Test 21 FAILED - incorrect exit status. Expected: 0 Got: $STATUS and $APPEND_STATUS"
+    FAIL=1
+elif [ $SIZE -ne 10 ]
+then
+    echo "**** Test 21 FAILED - eight folded codes should take nine bytes and a mark byte, not $SIZE"
+    FAIL=1
+elif ! cat fold_21.txt input_6.txt input_5.txt | diff -q - output.txt >/dev/null 2>&1
+then
+    echo "**** Test 21 FAILED - uncompressed output didin't match appended inputs"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 21 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 21 PASS"
+fi
+rm -f fold_21.txt
+
+# Folding case can't be turned on when appending to a file that wasn't folded.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 22: ./pack --append --fold input_6.txt compressed.raw > stdout.txt 2> stderr.txt"
+./pack input_5.txt compressed.raw
+./pack --append --fold input_6.txt compressed.raw > stdout.txt 2> stderr.txt
+STATUS=$?
+checkerror 22 $STATUS
+
+# Unpacking just the first few lines of a folded file should restore their capitals.
+rm -f compressed.raw output.txt stdout.txt stderr.txt
+echo "Test 23: ./unpack --lines 12 compressed.raw output.txt > stdout.txt 2> stderr.txt"
+./pack --fold input_6.txt compressed.raw > stdout.txt 2> stderr.txt
+./unpack --lines 12 compressed.raw output.txt >> stdout.txt 2>> stderr.txt
+STATUS=$?
+if [ $STATUS -ne 0 ]
+then
+    echo "**** Test 23 FAILED - incorrect exit status. Expected: 0 Got: $STATUS"
+    FAIL=1
+elif ! head -n 12 input_6.txt | diff -q - output.txt >/dev/null 2>&1
+then
+    echo "**** Test 23 FAILED - uncompressed output didin't match the first 12 lines of input"
+    FAIL=1
+elif [ -s stderr.txt ] || [ -s stdout.txt ]
+then
+    echo "**** Test 23 FAILED - shouldn't print anything to stdout or stderr"
+    FAIL=1
+else
+    echo "Test 23 PASS"
+fi
+
+# A file that can't be seeked can't be appended to.
+rm -f compressed.raw output.txt stdout.txt stderr.txt fifo_24
+echo "Test 24: ./pack --append input_4.txt fifo_24 > stdout.txt 2> stderr.txt"
+mkfifo fifo_24
+./pack --append input_4.txt fifo_24 > stdout.txt 2> stderr.txt
+STATUS=$?
+checkerror 24 $STATUS
+rm -f fifo_24
+
+# Text before a bad code should still come out, both from unpack and through the stdio stream.
+# longlist_25.txt is shortlist_19.txt with a word added at the end, so every earlier code means
+# the same thing in both lists.
+rm -f compressed.raw output.txt stdout.txt stderr.txt partial_25.txt
+echo "Test 25: ./unpack compressed.raw output.txt shortlist_19.txt, for a file packed with longlist_25.txt"
+printf 'the cat~~ sat\n' > partial_25.txt
+./pack partial_25.txt compressed.raw longlist_25.txt
+./unpack compressed.raw output.txt shortlist_19.txt > stdout.txt 2> stderr.txt
+STATUS=$?
+./rawcat compressed.raw shortlist_19.txt > partial_25.txt 2>> stderr.txt
+RAWCAT_STATUS=$?
+if [ $STATUS -eq 0 ] || [ $RAWCAT_STATUS -eq 0 ]
+then
+    echo "**** Test 25 FAILED - should have exited unsuccessfully."
+    FAIL=1
+elif [ "`cat output.txt`" != "the cat" ] || [ "`cat partial_25.txt`" != "the cat" ]
+then
+    echo "**** Test 25 FAILED - text before the bad code didn't come out"
+    FAIL=1
+elif [ `grep -c "^Invalid compressed file: compressed.raw$" stderr.txt` -ne 2 ] || [ -s stdout.txt ]
+then
+    echo "**** Test 25 FAILED - incorrect error message"
+    FAIL=1
+else
+    echo "Test 25 PASS"
+fi
+rm -f partial_25.txt
+
+# A damaged archive index should be reported, not trusted.  This one has no chunks and one
+# member whose name length is 0xFFFFFFFF, followed by a few bytes of name.
+rm -f stdout.txt stderr.txt bad_26.pka
+echo "Test 26: ./archive -t bad_26.pka > stdout.txt 2> stderr.txt"
+printf 'PKA2\014\0\0\0\0\0\0\0\0\0\0\0\001\0\0\0\377\377\377\377name' > bad_26.pka
+./archive -t bad_26.pka > stdout.txt 2> stderr.txt
+STATUS=$?
+checkerror 26 $STATUS
+rm -f bad_26.pka
+
 if [ $FAIL -ne 0 ]; then
   echo "FAILING TESTS!"
   exit 13
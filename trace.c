@@ -0,0 +1,251 @@
+/** 
+ * This file contains the tracing support for pack and unpack.  It keeps
+ * recent spans of work in a ring buffer for each thread and writes them
+ * out as a Chrome trace when the program finishes.
+ *  
+ * @file trace.c
+ * @author Louis Warner
+*/
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+/** Number of nanoseconds per microsecond, the time unit for Chrome traces. */
+#define NS_PER_US 1000.0
+
+/** Number of nanoseconds per second. */
+#define NS_PER_SEC 1000000000LL
+
+/** One recorded span of work. */
+typedef struct {
+  /** Name of the span, a string literal from the caller. */
+  char const *name;
+
+  /** Time the span started, in nanoseconds. */
+  long long start;
+
+  /** Time the span ended, in nanoseconds. */
+  long long end;
+} TraceEvent;
+
+/** Ring buffer of events for one thread.  Only the owning thread writes
+    to it, so it doesn't need a lock. */
+typedef struct {
+  /** Storage for the events, allocated when the thread records its first one. */
+  TraceEvent *events;
+
+  /** Total number of events recorded.  The newest one is at index
+      ( count - 1 ) % TRACE_CAPACITY. */
+  long long count;
+
+  /** True while a running thread owns the ring.  When the thread exits,
+      the ring keeps its events and can be handed to a later thread. */
+  bool inUse;
+} TraceRing;
+
+/** True if tracing is on.  It's only changed by traceInit() and
+    traceFinish(), while no other threads are running, so threads can
+    read it without a lock. */
+static bool enabled = false;
+
+/** Name of the file the trace is written to. */
+static char const *traceFile = NULL;
+
+/** Ring buffer for each thread. */
+static TraceRing rings[ TRACE_THREADS ];
+
+/** Number of ring buffers allocated so far. */
+static int ringCount = 0;
+
+/** True if a ring buffer couldn't be allocated.  After that, no more
+    rings are handed out.  It's protected by ringLock. */
+static bool failed = false;
+
+/** Lock for handing out and giving back ring buffers.  It's only taken
+    the first time a thread records an event, and when it exits. */
+static pthread_mutex_t ringLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Key for each thread's own ring buffer. */
+static pthread_key_t ringKey;
+
+/** Stand-in ring for threads that arrive after all the real ones are
+    handed out.  Their events are dropped. */
+static TraceRing noRing;
+
+/** Destructor for the ring key, run when a thread that recorded events
+    exits.  It gives the thread's ring back, so a later thread can add
+    its events to the same ring.
+    @param value the thread's ring, or noRing.
+*/
+static void releaseRing( void *value )
+{
+  TraceRing *ring = (TraceRing *) value;
+  if ( ring == &noRing ) {
+    return;
+  }
+  
+  pthread_mutex_lock( &ringLock );
+  ring->inUse = false;
+  pthread_mutex_unlock( &ringLock );
+}
+
+/** Turn tracing on if the TRACE_VARIABLE environment variable is set.
+    This should be called once, at the start of the program, before any
+    other threads are started.
+*/
+void traceInit( void )
+{
+  traceFile = getenv( TRACE_VARIABLE );
+  if ( traceFile == NULL || traceFile[ 0 ] == '\0' ) {
+    traceFile = NULL;
+    return;
+  }
+  
+  enabled = pthread_key_create( &ringKey, releaseRing ) == 0;
+  if ( !enabled ) {
+    traceFile = NULL;
+  }
+}
+
+/** Return the ring buffer for the calling thread, handing it one the
+    first time.  A ring given back by a thread that has exited is used
+    before a new one is allocated.  If there's no memory for a new ring,
+    tracing is turned off for every thread that doesn't have one yet.
+    @return ring for this thread, or NULL if its events are to be dropped.
+*/
+static TraceRing *threadRing( void )
+{
+  TraceRing *ring = (TraceRing *) pthread_getspecific( ringKey );
+  if ( ring != NULL ) {
+    return ring == &noRing ? NULL : ring;
+  }
+  
+  pthread_mutex_lock( &ringLock );
+  for ( int t = 0; ring == NULL && t < ringCount; t++ ) {
+    if ( !rings[ t ].inUse ) {
+      ring = rings + t;
+    }
+  }
+  if ( ring == NULL && !failed && ringCount < TRACE_THREADS ) {
+    ring = rings + ringCount;
+    ring->events = (TraceEvent *)malloc( TRACE_CAPACITY * sizeof( TraceEvent ) );
+    if ( ring->events == NULL ) {
+      fprintf(stderr, "Can't allocate trace buffer, tracing turned off\n");
+      failed = true;
+      ring = NULL;
+    } else {
+      ringCount++;
+    }
+  }
+  if ( ring != NULL ) {
+    ring->inUse = true;
+  }
+  pthread_mutex_unlock( &ringLock );
+  
+  pthread_setspecific( ringKey, ring == NULL ? &noRing : ring );
+  return ring;
+}
+
+/** Return the current time, to mark the start of a span.  If tracing is
+    off, this just returns zero, without reading the clock.
+    @return current time in nanoseconds, or zero if tracing is off.
+*/
+long long traceClock( void )
+{
+  if ( !enabled ) {
+    return 0;
+  }
+  
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return now.tv_sec * NS_PER_SEC + now.tv_nsec;
+}
+
+/** Record a span of work that started at the given time and ends now,
+    in the ring buffer for the calling thread.  If tracing is off, this
+    returns right away.
+    @param name name for this kind of span, a string literal.
+    @param start time the span started, from traceClock().
+*/
+void traceSpan( char const *name, long long start )
+{
+  if ( !enabled ) {
+    return;
+  }
+  
+  TraceRing *ring = threadRing();
+  if ( ring == NULL ) {
+    return;
+  }
+  
+  TraceEvent *event = ring->events + ring->count % TRACE_CAPACITY;
+  event->name = name;
+  event->start = start;
+  event->end = traceClock();
+  ring->count++;
+}
+
+/** If tracing was turned on, write out all the recorded events and free
+    the ring buffers.  This should be called once, at the end of the program, after
+    any other threads have finished.
+*/
+void traceFinish( void )
+{
+  // Even if tracing was turned off part way, write out what we have.
+  if ( traceFile == NULL ) {
+    return;
+  }
+  
+  FILE *fp;
+  if (( fp = fopen( traceFile, "w" )) == NULL ) {
+    fprintf(stderr, "Can't open trace file: %s\n", traceFile);
+    exit( EXIT_FAILURE );
+  }
+  
+  // Report times relative to the earliest event we still have.
+  long long base = -1;
+  for ( int t = 0; t < ringCount; t++ ) {
+    TraceRing *ring = rings + t;
+    long long first = ring->count > TRACE_CAPACITY ? ring->count - TRACE_CAPACITY : 0;
+    for ( long long i = first; i < ring->count; i++ ) {
+      long long start = ring->events[ i % TRACE_CAPACITY ].start;
+      if ( base < 0 || start < base ) {
+        base = start;
+      }
+    }
+  }
+  
+  // Write each thread's events, oldest first, as complete ("X") events.
+  fprintf( fp, "{\"traceEvents\":[" );
+  bool firstEvent = true;
+  for ( int t = 0; t < ringCount; t++ ) {
+    TraceRing *ring = rings + t;
+    long long first = ring->count > TRACE_CAPACITY ? ring->count - TRACE_CAPACITY : 0;
+    for ( long long i = first; i < ring->count; i++ ) {
+      TraceEvent *event = ring->events + i % TRACE_CAPACITY;
+      fprintf( fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+               firstEvent ? "" : ",", event->name, t,
+               ( event->start - base ) / NS_PER_US, ( event->end - event->start ) / NS_PER_US );
+      firstEvent = false;
+    }
+    free( ring->events );
+    ring->events = NULL;
+    ring->count = 0;
+    ring->inUse = false;
+  }
+  fprintf( fp, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+  
+  fclose( fp );
+  pthread_key_delete( ringKey );
+  ringCount = 0;
+  failed = false;
+  enabled = false;
+  traceFile = NULL;
+}
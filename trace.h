@@ -0,0 +1,55 @@
+/** 
+ * Header file for the trace.c component, with functions for recording
+ * timed spans of work and writing them out as a Chrome trace.
+ *  
+ * @file trace.h
+ * @author Louis Warner
+*/
+
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/** Name of the environment variable that turns tracing on.  Its value is
+    the name of the file the trace is written to, in Chrome trace JSON
+    format, which chrome://tracing or Perfetto can open. */
+#define TRACE_VARIABLE "PACK_TRACE"
+
+/** Maximum number of threads that can record events at once.  Each one
+    gets its own ring buffer the first time it records an event, so
+    recording never needs a lock after that.  When a thread exits, its
+    ring is handed on to the next new thread, events and all.  Events
+    from threads beyond this many at once are dropped. */
+#define TRACE_THREADS 64
+
+/** Number of events kept for each thread.  Once a thread's ring buffer
+    is full, its oldest events are overwritten. */
+#define TRACE_CAPACITY 16384
+
+/** Turn tracing on if the TRACE_VARIABLE environment variable is set.
+    This should be called once, at the start of the program, before any
+    other threads are started.
+*/
+void traceInit( void );
+
+/** Return the current time, to mark the start of a span.  If tracing is
+    off, this just returns zero, without reading the clock.
+    @return current time in nanoseconds, or zero if tracing is off.
+*/
+long long traceClock( void );
+
+/** Record a span of work that started at the given time and ends now,
+    in the ring buffer for the calling thread.  If tracing is off, this
+    returns right away.
+    @param name name for this kind of span, a string literal.
+    @param start time the span started, from traceClock().
+*/
+void traceSpan( char const *name, long long start );
+
+/** If tracing was turned on, write out all the recorded events and free
+    the ring buffers.  This should be called once, at the end of the program, after
+    any other threads have finished.
+*/
+void traceFinish( void );
+
+#endif
@@ -15,63 +15,103 @@
 
 #include "wordlist.h"
 #include "bits.h"
+#include "reader.h"
+#include "trace.h"
 
 /**
  * This is the main function for unpack.c, it takes either 2 or 3 command line arguments.
- * If it is given only two arguments, it will use the default word list in the file "words.txt".
+ * If it is given only two arguments, it will use the default word list built in from "words.txt".
  * A third argument will switch the word list to whatever the user specified file is.
+ * With the --lines option in front, only the first N lines are unpacked, and the
+ * rest of the compressed file is never decoded.
  */
 int main( int argc, char *argv[] )
 {
-  char *wordFile = "words.txt";
-
-  // Check command-line arguments and open the input file.
-  FILE *input;
+  // Check command-line options and arguments.
+  Reader *input;
   FILE *output;
+  int lines = -1;
+  
+  if ( argc > 2 && strcmp( argv[ 1 ], "--lines" ) == 0 )
+  {
+    char extra;
+    if ( sscanf( argv[ 2 ], "%d%c", &lines, &extra ) != 1 || lines < 0 )
+    {
+      fprintf(stderr, "usage: unpack [--lines N] <compressed.raw> <output.txt> [word_file.txt]\n");
+      exit( EXIT_FAILURE );
+    }
+    argc -= 2;
+    argv += 2;
+  }
   
   if ( argc != 3 && argc != 4 )
   {
-      fprintf(stderr, "usage: unpack <compressed.raw> <output.txt> [word_file.txt]\n");
+      fprintf(stderr, "usage: unpack [--lines N] <compressed.raw> <output.txt> [word_file.txt]\n");
       exit( EXIT_FAILURE );
   }
   
-  // If the user provides a wordfile, replace the default wordfile.
+  // Turn on tracing, if it's requested in the environment.
+  traceInit();
+  
+  // If the user provides a wordfile, use it instead of the built-in default list.
+  long long start = traceClock();
+  WordList *wordList;
   if (argc == 4)
   {
-    wordFile = argv[ 3 ];
+    wordList = readWordList( argv[ 3 ] );
+  } else {
+    wordList = defaultWordList();
   }
-  
-  WordList *wordList = readWordList( wordFile );
+  traceSpan( "dictionary load", start );
   
   // Check for valid input and output files.
-  if((input = fopen( argv[ 1 ], "r" ) ) == NULL ) 
+  if((input = openReader( argv[ 1 ], wordList ) ) == NULL ) 
   {
     fprintf(stderr, "Can't open file: %s\n", argv[ 1 ]);
-    fprintf(stderr, "usage: unpack <compressed.raw> <output.txt> [word_file.txt]\n");
+    fprintf(stderr, "usage: unpack [--lines N] <compressed.raw> <output.txt> [word_file.txt]\n");
     exit( EXIT_FAILURE );
   }
   if((output = fopen( argv[ 2 ], "w" ))  == NULL )
   {
     fprintf(stderr, "Can't open file: %s\n", argv[ 2 ]);
-    fprintf(stderr, "usage: unpack <compressed.raw> <output.txt> [word_file.txt]\n");
+    fprintf(stderr, "usage: unpack [--lines N] <compressed.raw> <output.txt> [word_file.txt]\n");
     exit( EXIT_FAILURE );
   }
   
-  // Initialize PendingBits struct and integer for the word code.
-  PendingBits pending = { 0, 0 };
-  int code = 0;
+  // Text decoded from the input, waiting to be written out.
+  char text[ BUFSIZ ];
+  long len = 0;
   
-  while(!feof(input)){
-    code = readCode( &pending, input );
-    if(code != -1){
-      fprintf(output, "%s", wordList->words[code] );
+  if ( lines < 0 ) {
+    // Copy all the text, a buffer full at a time.
+    while ( ( len = readText( input, text, sizeof( text ) ) ) > 0 ) {
+      start = traceClock();
+      fwrite( text, 1, len, output );
+      traceSpan( "write", start );
+    }
+  } else {
+    // Copy just the first few lines.  A line longer than the buffer comes in pieces,
+    // so it's only done when we get a piece ending in a newline.
+    while ( lines > 0 && ( len = readLine( input, text, sizeof( text ) ) ) > 0 ) {
+      fwrite( text, 1, len, output );
+      if ( text[ len - 1 ] == '\n' ) {
+        lines--;
+      }
     }
   }
   
+  // The reader stops with an error on a code that isn't in the word list.
+  if ( len < 0 )
+  {
+    fprintf(stderr, "Invalid compressed file: %s\n", argv[ 1 ]);
+    exit( EXIT_FAILURE );
+  }
+  
   // Free any allocated memory and close files.
   freeWordList(wordList);
-  fclose(input);
+  closeReader(input);
   fclose(output);
+  traceFinish();
 
   return EXIT_SUCCESS;
 }
\ No newline at end of file
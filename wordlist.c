@@ -40,7 +40,9 @@ typedef struct {
   /** Number of words in the wordlist. */
   int len;
 
-  /** Capacity of the wordlist, so we can know when we need to resize. */
+  /** Capacity of the wordlist, so we can know when we need to resize.
+      A capacity of zero marks a list in static storage, like the
+      built-in default list, which is never resized or freed. */
   int capacity;
 
   /** List of words.  Should be sorted lexicographically once the word list
@@ -253,6 +255,11 @@ int bestCode( WordList *wordList, char const *str )
  */
 void freeWordList( WordList *wordList )
 {
+  // The default list lives in static storage.
+  if ( wordList->capacity == 0 ) {
+    return;
+  }
+  
   free( wordList->words );
   free( wordList );
 }
\ No newline at end of file
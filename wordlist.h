@@ -26,7 +26,9 @@ typedef struct {
   /** Number of words in the wordlist. */
   int len;
 
-  /** Capacity of the wordlist, so we can know when we need to resize. */
+  /** Capacity of the wordlist, so we can know when we need to resize.
+      A capacity of zero marks a list in static storage, like the
+      built-in default list, which is never resized or freed. */
   int capacity;
 
   /** List of words.  Should be sorted lexicographically once the word list
@@ -61,6 +63,16 @@ bool validChar( char ch );
 WordList *readWordList( char const *fname );
 
 
+/**
+ * This function returns the built-in default word list, generated from words.txt
+ * at build time.  Using it doesn't read any files or do any sorting, and the
+ * returned list is shared, so it's fine to pass it to freeWordList().
+ *
+ * @return Wordlist *list - a pointer to the default word list
+ */
+WordList *defaultWordList( void );
+
+
 /**
  * This function takes a string and compares it to the strings in the word list.
  * It utilizes binary search methods for efficient searching through the word list.